@@ -8,6 +8,16 @@
 /* ------------------------------------------------ */
 
 #include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
 #include "Repacker.h"
 #include "VibRipper.h"
 
@@ -55,15 +65,6 @@ int Repacker::Repack()
 {
 	std::cout << "[R] Repacking '" << inputDir.string() << "'..." << std::endl;
 
-	// Create & open PAK
-	std::ofstream pakFile;
-	pakFile.open(pak.string(), std::ios::out | std::ios::binary);
-	if (!pakFile.is_open() || !pakFile.good())
-	{
-		std::cerr << "[U] Could not create file '" << pak.string() << "' for writing." << std::endl;
-		return EXIT_FAILURE;
-	}
-
 	std::cout << "[R] Generating header..." << std::endl;
 
 	// Header size as first offset
@@ -102,6 +103,25 @@ int Repacker::Repack()
 		// The above factors in the offset of the file, the name & name padding, the length field, the file data length, and the file data null padding
 	}
 
+	// Total PAK size: file count, offset table, then every entry
+	long long pakSize = 4 + (4 * (long long)offsets.size());
+	for (int i = 0; i < fileCount; i++)
+		pakSize += (long long)names[i].size() + 1 + nullPadName[i] + 4 + lengths[i] + nullPad[i];
+
+	// Write to a temporary PAK beside the real one, so a failed repack never leaves a truncated PAK behind
+	if (!AllocateFile(pakSize))
+		return EXIT_FAILURE;
+
+	// Open PAK without truncating the allocated space
+	std::ofstream pakFile;
+	pakFile.open(tempPak.string(), std::ios::in | std::ios::out | std::ios::binary);
+	if (!pakFile.is_open() || !pakFile.good())
+	{
+		std::cerr << "[R] Could not open file '" << tempPak.string() << "' for writing." << std::endl;
+		DiscardFile();
+		return EXIT_FAILURE;
+	}
+
 	// Write PAK
 	std::cout << "[R] Writing file count..." << std::endl;
 	pakFile.write((char *)&fileCount, 4);
@@ -128,18 +148,44 @@ int Repacker::Repack()
 		if (!inFile.is_open() || !inFile.good())
 		{
 			std::cerr << "[U] Could not open file '" << paths[i].string() << "' for reading." << std::endl;
+			pakFile.close();
+			DiscardFile();
 			return EXIT_FAILURE;
 		}
 
 		// Write data to PAK
 		WriteBytes(lengths[i], inFile, pakFile);
+		if (!inFile.good())
+		{
+			std::cerr << "[R] Could not read all " << lengths[i] << " bytes of file '" << paths[i].string() << "'; did it change during repacking?" << std::endl;
+			pakFile.close();
+			DiscardFile();
+			return EXIT_FAILURE;
+		}
 		while (nullPad[i]-- != 0)
 			pakFile.put('\0');
 	}
 
+	// Make sure every write landed and filled exactly the allocated space before replacing the old PAK
+	long long written = (long long)pakFile.tellp();
+	pakFile.close();
+	if (pakFile.fail() || written != pakSize)
+	{
+		std::cerr << "[R] Failed while writing file '" << tempPak.string() << "' (wrote " << written << " of " << pakSize << " bytes)." << std::endl;
+		DiscardFile();
+		return EXIT_FAILURE;
+	}
+
+	// Replace the old PAK in one step
+	std::cout << "[R] Publishing '" << pak.filename().string() << "'..." << std::endl;
+	if (!PublishFile())
+	{
+		DiscardFile();
+		return EXIT_FAILURE;
+	}
+
 	// Tie up loose ends
 	std::cout << "[R] Done repacking files." << std::endl;
-	pakFile.close();
 
 	return EXIT_SUCCESS;
 }
@@ -243,3 +289,143 @@ void Repacker::WriteBytes(int n, std::ifstream& is, std::ofstream& os)
 		os.write((char*)outBuf, toRead);
 	}
 }
+
+/* Creates a uniquely named temporary PAK beside the output PAK with its full size allocated up front. */
+int Repacker::AllocateFile(long long size)
+{
+	// Create file under a name no other file or repack is using
+#ifdef _WIN32
+	int pid = _getpid();
+#else
+	int pid = (int)getpid();
+#endif
+	for (int attempt = 0; tempFd == -1 && attempt < 100; attempt++)
+	{
+		tempPak = std::filesystem::path(pak.string() + "." + std::to_string(pid) + "." + std::to_string(attempt) + ".tmp");
+#ifdef _WIN32
+		tempFd = _open(tempPak.string().c_str(), _O_RDWR | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+		tempFd = open(tempPak.string().c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+#endif
+		if (tempFd == -1 && errno != EEXIST)
+			break;
+	}
+	if (tempFd == -1)
+	{
+		int openErr = errno;
+		std::cerr << "[R] Could not create file '" << tempPak.string() << "' for writing:" << std::endl;
+		std::cerr << "[R] " << openErr << ": " << std::strerror(openErr) << std::endl;
+		return 0;
+	}
+
+	// Reserve all blocks at once, which keeps the PAK contiguous and fails early if the disk is full
+	int err = 0;
+#ifdef _WIN32
+	// NTFS reserves the clusters when the end-of-file is moved
+	err = _chsize_s(tempFd, size);
+#elif defined(__APPLE__)
+	// No posix_fallocate here; ask for contiguous space first, then any space
+	fstore_t store = { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)size, 0 };
+	if (fcntl(tempFd, F_PREALLOCATE, &store) == -1)
+	{
+		store.fst_flags = F_ALLOCATEALL;
+		if (fcntl(tempFd, F_PREALLOCATE, &store) == -1)
+			err = errno;
+	}
+	if (err == 0 && ftruncate(tempFd, (off_t)size) == -1)
+		err = errno;
+#else
+	err = posix_fallocate(tempFd, 0, (off_t)size);
+	// Some filesystems cannot preallocate; settle for setting the size
+	if ((err == EINVAL || err == EOPNOTSUPP) && ftruncate(tempFd, (off_t)size) == 0)
+		err = 0;
+#endif
+	if (err != 0)
+	{
+		std::cerr << "[R] Failed to allocate " << size << " bytes for file '" << tempPak.string() << "':" << std::endl;
+		std::cerr << "[R] " << err << ": " << std::strerror(err) << std::endl;
+		DiscardFile();
+		return 0;
+	}
+
+	return 1;
+}
+
+/* Flushes the temporary PAK to the disk and moves it over the output PAK, keeping the old PAK's permissions. */
+int Repacker::PublishFile()
+{
+	// Keep the permissions of the PAK being replaced; the open descriptor stays writable either way
+	std::error_code permErr;
+	std::filesystem::file_status pakStatus = std::filesystem::status(pak, permErr);
+	if (!permErr && std::filesystem::exists(pakStatus))
+	{
+		std::filesystem::permissions(tempPak, pakStatus.permissions(), permErr);
+		if (permErr)
+		{
+			std::cerr << "[R] Failed to copy permissions of '" << pak.string() << "' to file '" << tempPak.string() << "':" << std::endl;
+			std::cerr << "[R] " << permErr << ": " << permErr.message() << std::endl;
+			return 0;
+		}
+	}
+
+	// Flush file contents to the disk through the descriptor we created it with
+#ifdef _WIN32
+	int syncErr = (_commit(tempFd) != 0) ? errno : 0;
+	_close(tempFd);
+#else
+	int syncErr = (fsync(tempFd) != 0) ? errno : 0;
+	close(tempFd);
+#endif
+	tempFd = -1;
+	if (syncErr != 0)
+	{
+		std::cerr << "[R] Failed to flush file '" << tempPak.string() << "' to the disk:" << std::endl;
+		std::cerr << "[R] " << syncErr << ": " << std::strerror(syncErr) << std::endl;
+		return 0;
+	}
+
+	// Atomically replace the output PAK
+	try
+	{
+		std::filesystem::rename(tempPak, pak);
+	}
+	catch (std::filesystem::filesystem_error &err)
+	{
+		std::cerr << "[R] Failed to move file '" << tempPak.string() << "' to '" << pak.string() << "':" << std::endl;
+		std::cerr << "[R] " << err.code() << ": " << err.what() << std::endl;
+		return 0;
+	}
+
+#ifndef _WIN32
+	// Flush the parent directory so the rename itself survives a crash; the PAK is already in place, so only warn
+	int dirFd = open(pak.parent_path().string().c_str(), O_RDONLY);
+	if (dirFd == -1 || fsync(dirFd) != 0)
+		syncErr = errno;
+	if (dirFd != -1)
+		close(dirFd);
+	if (syncErr != 0)
+	{
+		std::cerr << "[R] Warning: '" << pak.filename().string() << "' was published, but directory '" << pak.parent_path().string() << "' could not be flushed to the disk:" << std::endl;
+		std::cerr << "[R] " << syncErr << ": " << std::strerror(syncErr) << std::endl;
+	}
+#endif
+
+	return 1;
+}
+
+/* Closes and deletes the temporary PAK. */
+void Repacker::DiscardFile()
+{
+	if (tempFd != -1)
+	{
+#ifdef _WIN32
+		_close(tempFd);
+#else
+		close(tempFd);
+#endif
+		tempFd = -1;
+	}
+
+	std::error_code err;
+	std::filesystem::remove(tempPak, err);
+}
@@ -34,10 +34,18 @@ private:
 	int ReadDirectory(std::filesystem::path &dir);
 	/* Reads a given number of bytes from an ifstream and writes them to an ofstream. */
 	void WriteBytes(int n, std::ifstream& is, std::ofstream& os);
+	/* Creates a uniquely named temporary PAK beside the output PAK with its full size allocated up front. */
+	int AllocateFile(long long size);
+	/* Flushes the temporary PAK to the disk and moves it over the output PAK, keeping the old PAK's permissions. */
+	int PublishFile();
+	/* Closes and deletes the temporary PAK. */
+	void DiscardFile();
 	bool isReady = false;
 	std::filesystem::path inputDir;
 	std::filesystem::path pak;
-	int fileCount;
+	std::filesystem::path tempPak;
+	int tempFd = -1;
+	int fileCount = 0;
 	std::vector<int> toc;
 	std::vector<std::string> names;
 	std::vector<std::filesystem::path> paths;
@@ -8,15 +8,21 @@
 /* ------------------------------------------------ */
 
 #include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <map>
+#include <set>
 #include "Unpacker.h"
 #include "VibRipper.h"
 
-/* Initialize an Unpacker to unpack a PAK file into a given output directory. */
-Unpacker::Unpacker(std::string fileName, std::string outDir)
+/* Initialize an Unpacker to unpack a PAK file into a given output directory, optionally skipping unchanged files and removing stale ones. */
+Unpacker::Unpacker(std::string fileName, std::string outDir, bool incremental, bool prune)
 {
     std::cout << "[U] Initializing Unpacker..." << std::endl;
 
     this->fileName = std::filesystem::path(fileName);
+    this->incremental = incremental || prune;
+    this->prune = prune;
 
     if (!OpenPAK())
         return;
@@ -55,6 +61,8 @@ int Unpacker::Unpack()
     if (!ReadTOC())
         return 0;
 
+    int skipped = 0;
+
     // Traverse archive
     for (int i = 0; i < fileCount; i++)
     {
@@ -93,8 +101,25 @@ int Unpacker::Unpack()
                 return EXIT_FAILURE;
         }
 
+        std::filesystem::path outPath = outputDir.string() + (char)std::filesystem::path::preferred_separator + name;
+
+        // Leave identical files alone so their timestamps are preserved
+        if (incremental)
+        {
+            std::streampos dataPos = pak.tellg();
+            bool unchanged = MatchesFile(fileLen, pak, outPath);
+            pak.clear();
+            pak.seekg(dataPos);
+            if (unchanged)
+            {
+                std::cout << "[U] Skipping " << name << ", unchanged." << std::endl;
+                skipped++;
+                continue;
+            }
+        }
+
         // Create output
-        std::ofstream outFile(outputDir.string() + (char)std::filesystem::path::preferred_separator + name, std::ios::out | std::ios::binary);
+        std::ofstream outFile(outPath, std::ios::out | std::ios::binary);
         if (!outFile.is_open() || !outFile.good())
         {
             std::cerr << "[U] Could not open file '" << name << "' for writing." << std::endl;
@@ -109,6 +134,16 @@ int Unpacker::Unpack()
     }
 
     std::cout << "[U] Done unpacking files." << std::endl;
+    if (incremental)
+        std::cout << "[U] " << fileCount - skipped << " files written, " << skipped << " files unchanged." << std::endl;
+
+    // Remove files no longer in the PAK
+    if (prune)
+    {
+        std::cout << "[U] Removing stale files..." << std::endl;
+        if (!PruneDir())
+            return EXIT_FAILURE;
+    }
 
     // Write table of contents
     std::cout << "[U] Writing table of contents..." << std::endl;
@@ -194,6 +229,162 @@ void Unpacker::WriteBytes(int n, std::ifstream &is, std::ofstream &os)
     }
 }
 
+/* Compares a given number of bytes from an ifstream against an existing file. */
+bool Unpacker::MatchesFile(int n, std::ifstream &is, std::filesystem::path &file)
+{
+    // Cheap checks first
+    std::error_code err;
+    if (!std::filesystem::is_regular_file(file, err) || std::filesystem::file_size(file, err) != (std::uintmax_t)n || err)
+        return false;
+
+    std::ifstream oldFile(file.string(), std::ios::in | std::ios::binary);
+    if (!oldFile.is_open() || !oldFile.good())
+        return false;
+
+    // Sizes match, compare contents
+    char pakBuf[UBUF];
+    char oldBuf[UBUF];
+    int bytesLeft = n;
+    int toRead = 0;
+    while (bytesLeft != 0)
+    {
+        toRead = (bytesLeft >= UBUF) ? UBUF : bytesLeft;
+        is.read(pakBuf, toRead);
+        oldFile.read(oldBuf, toRead);
+        if (!is.good() || !oldFile.good() || std::memcmp(pakBuf, oldBuf, toRead) != 0)
+            return false;
+        bytesLeft -= toRead;
+    }
+
+    return true;
+}
+
+/* Reads the file names from the TOC file written by a previous unpack, if any. */
+int Unpacker::ReadOldTOC(std::vector<std::string> &oldNames)
+{
+    // Open TOC
+    std::ifstream tocFile(fileName.string() + "_TOC.txt", std::ios::in);
+    if (!tocFile.is_open() || !tocFile.good())
+        return 0;
+
+    // Read magic header
+    std::string header;
+    getline(tocFile, header);
+    if (header.rfind("### " + std::string(PROGRAM) + " v", 0) != 0)
+        return 0;
+
+    // Skip PAK file name, read file count
+    std::string line;
+    getline(tocFile, line);
+    if (!getline(tocFile, line))
+        return 0;
+    int oldCount = 0;
+    try
+    {
+        oldCount = std::stoi(line);
+    }
+    catch (std::exception &)
+    {
+        return 0;
+    }
+
+    // Read in all file names
+    for (int i = 0; i < oldCount; i++)
+    {
+        if (!getline(tocFile, line))
+            return 0;
+        oldNames.push_back(line);
+    }
+
+    tocFile.close();
+
+    return 1;
+}
+
+/* Removes files listed in the previous TOC that are no longer in the PAK, along with directories this leaves empty. */
+int Unpacker::PruneDir()
+{
+    // Only files a previous unpack of this PAK wrote are candidates
+    std::vector<std::string> oldNames;
+    if (!ReadOldTOC(oldNames))
+    {
+        std::cout << "[U] No previous TOC file found, nothing to remove." << std::endl;
+        return 1;
+    }
+
+    // Compare against a clean output path, dropping any trailing separator or '.'
+    std::filesystem::path baseDir = outputDir.lexically_normal();
+    if (!baseDir.has_filename() && baseDir.has_relative_path())
+        baseDir = baseDir.parent_path();
+
+    // Current names, plus a case-folded lookup for names that may be the same file on a case-insensitive filesystem
+    std::set<std::filesystem::path> keep;
+    std::map<std::string, std::filesystem::path> keepFolded;
+    for (const std::string &name : names)
+    {
+        std::filesystem::path relPath = std::filesystem::path(name).lexically_normal();
+        keep.insert(relPath);
+        keepFolded[FoldCase(relPath.generic_string())] = relPath;
+    }
+
+    int removed = 0;
+    try
+    {
+        for (const std::string &name : oldNames)
+        {
+            std::filesystem::path relPath = std::filesystem::path(name).lexically_normal();
+            if (keep.find(relPath) != keep.end())
+                continue;
+
+            // Never leave the output directory
+            if (relPath.empty() || relPath.is_absolute() || relPath.has_root_path() || *relPath.begin() == "..")
+                continue;
+
+            std::filesystem::path file = baseDir / relPath;
+            std::filesystem::file_status status = std::filesystem::symlink_status(file);
+            if (!std::filesystem::exists(status) || std::filesystem::is_directory(status))
+                continue;
+
+            // Same file as a current entry under a different case
+            std::error_code err;
+            auto folded = keepFolded.find(FoldCase(relPath.generic_string()));
+            if (folded != keepFolded.end() && std::filesystem::equivalent(file, baseDir / folded->second, err))
+                continue;
+
+            std::cout << "[U] Removing " << relPath.string() << "..." << std::endl;
+            std::filesystem::remove(file);
+            removed++;
+
+            // Remove parent directories this emptied, stopping at the output directory
+            for (std::filesystem::path dir = file.parent_path(); dir != baseDir && dir.has_relative_path(); dir = dir.parent_path())
+            {
+                std::filesystem::file_status dirStatus = std::filesystem::symlink_status(dir);
+                if (!std::filesystem::is_directory(dirStatus) || !std::filesystem::is_empty(dir))
+                    break;
+                std::cout << "[U] Removing empty directory " << dir.lexically_relative(baseDir).string() << "..." << std::endl;
+                std::filesystem::remove(dir);
+            }
+        }
+    }
+    catch (std::filesystem::filesystem_error &err)
+    {
+        std::cerr << "[U] Failed to remove stale files from output directory '" << outputDir.string() << "':" << std::endl;
+        std::cerr << "[U] " << err.code() << ": " << err.what() << std::endl;
+        return 0;
+    }
+
+    std::cout << "[U] " << removed << " stale files removed." << std::endl;
+
+    return 1;
+}
+
+/* Lowercases a string for case-insensitive comparison. */
+std::string Unpacker::FoldCase(std::string str)
+{
+    std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return str;
+}
+
 /* Creates a text file representing a PAK TOC. */
 int Unpacker::WriteTOC()
 {
@@ -21,8 +21,8 @@ constexpr int UBUF = 2048;
 class Unpacker
 {
 public:
-    /* Initialize an Unpacker to unpack a PAK file into a given output directory. */
-    Unpacker(std::string fileName, std::string outDir);
+    /* Initialize an Unpacker to unpack a PAK file into a given output directory, optionally skipping unchanged files and removing stale ones. */
+    Unpacker(std::string fileName, std::string outDir, bool incremental = false, bool prune = false);
     /* Evaluates whether this Unpacker was constructed without error. */
     bool IsReady() const;
     /* Unpack the given PAK file. */
@@ -36,9 +36,19 @@ private:
     int CreateDir(std::filesystem::path &dir);
     /* Reads a given number of bytes from an ifstream and writes them to an ofstream. */
     void WriteBytes(int n, std::ifstream &is, std::ofstream &os);
+    /* Compares a given number of bytes from an ifstream against an existing file. */
+    bool MatchesFile(int n, std::ifstream &is, std::filesystem::path &file);
+    /* Reads the file names from the TOC file written by a previous unpack, if any. */
+    int ReadOldTOC(std::vector<std::string> &oldNames);
+    /* Removes files listed in the previous TOC that are no longer in the PAK, along with directories this leaves empty. */
+    int PruneDir();
+    /* Lowercases a string for case-insensitive comparison. */
+    static std::string FoldCase(std::string str);
     /* Creates a text file representing a PAK TOC. */
     int WriteTOC();
     bool isReady = false;
+    bool incremental = false;
+    bool prune = false;
     std::filesystem::path fileName;
     std::filesystem::path outputDir;
     std::ifstream pak;
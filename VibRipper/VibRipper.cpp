@@ -51,6 +51,8 @@ int main(int argc, char** argv)
 
     // Unpack
     case 'u':
+    case 'i':
+    case 'p':
     {
         // Check args
         if (argc < 3 || argc > 4)
@@ -60,7 +62,7 @@ int main(int argc, char** argv)
         }
 
         // Instantiate
-        Unpacker u(argv[2], argc == 4 ? argv[3] : "");
+        Unpacker u(argv[2], argc == 4 ? argv[3] : "", *argv[1] == 'i', *argv[1] == 'p');
 
         // Unpack if possible
         if (u.IsReady())
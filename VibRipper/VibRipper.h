@@ -17,11 +17,13 @@ const int MAJORVER = 1;
 const int MINORVER = 2;
 const std::string VERSION = std::to_string(MAJORVER) + "." + std::to_string(MINORVER);
 constexpr std::string_view AUTHOR = "ResistivKai";
-constexpr std::string_view USAGE = "{ u <pakfile> [outdir] | r <indir> [tocfile] }";
+constexpr std::string_view USAGE = "{ u | i | p <pakfile> [outdir] | r <indir> [tocfile] }";
 const std::vector<std::string_view> OPTIONS =
 {
     "h\t\t\tPrint a help page to output (hey, you're here!).",
     "u <pakfile> [outdir]\tUnpack a specified *.PAK file to an optionally defined directory.",
+    "i <pakfile> [outdir]\tUnpack like 'u', but only write files that differ from those already in the directory.",
+    "p <pakfile> [outdir]\tUnpack like 'i', and also remove files a previous unpack wrote that are no longer in the PAK.",
     "r <indir> [tocfile]\tRepack a specified directory using an optionally defined table of contents file."
 };
 